@@ -0,0 +1,89 @@
+#include "src/curve25519.h"
+#include "src/field.h"
+#include "src/montgomery.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ITERATIONS_LADDER 2000
+#define ITERATIONS_MUL 2000000
+
+
+/**
+ * Test vectors from RFC 7748, sections 5.2 and 6.1
+ */
+static const struct {
+    u8 scalar[32];
+    u8 u[32];
+    u8 expected[32];
+} vectors[] = {
+        {{0xa5, 0x46, 0xe3, 0x6b, 0xf0, 0x52, 0x7c, 0x9d, 0x3b, 0x16, 0x15, 0x4b, 0x82, 0x46, 0x5e, 0xdd,
+          0x62, 0x14, 0x4c, 0x0a, 0xc1, 0xfc, 0x5a, 0x18, 0x50, 0x6a, 0x22, 0x44, 0xba, 0x44, 0x9a, 0xc4},
+         {0xe6, 0xdb, 0x68, 0x67, 0x58, 0x30, 0x30, 0xdb, 0x35, 0x94, 0xc1, 0xa4, 0x24, 0xb1, 0x5f, 0x7c,
+          0x72, 0x66, 0x24, 0xec, 0x26, 0xb3, 0x35, 0x3b, 0x10, 0xa9, 0x03, 0xa6, 0xd0, 0xab, 0x1c, 0x4c},
+         {0xc3, 0xda, 0x55, 0x37, 0x9d, 0xe9, 0xc6, 0x90, 0x8e, 0x94, 0xea, 0x4d, 0xf2, 0x8d, 0x08, 0x4f,
+          0x32, 0xec, 0xcf, 0x03, 0x49, 0x1c, 0x71, 0xf7, 0x54, 0xb4, 0x07, 0x55, 0x77, 0xa2, 0x85, 0x52}},
+        {{0x4b, 0x66, 0xe9, 0xd4, 0xd1, 0xb4, 0x67, 0x3c, 0x5a, 0xd2, 0x26, 0x91, 0x95, 0x7d, 0x6a, 0xf5,
+          0xc1, 0x1b, 0x64, 0x21, 0xe0, 0xea, 0x01, 0xd4, 0x2c, 0xa4, 0x16, 0x9e, 0x79, 0x18, 0xba, 0x0d},
+         {0xe5, 0x21, 0x0f, 0x12, 0x78, 0x68, 0x11, 0xd3, 0xf4, 0xb7, 0x95, 0x9d, 0x05, 0x38, 0xae, 0x2c,
+          0x31, 0xdb, 0xe7, 0x10, 0x6f, 0xc0, 0x3c, 0x3e, 0xfc, 0x4c, 0xd5, 0x49, 0xc7, 0x15, 0xa4, 0x93},
+         {0x95, 0xcb, 0xde, 0x94, 0x76, 0xe8, 0x90, 0x7d, 0x7a, 0xad, 0xe4, 0x5c, 0xb4, 0xb8, 0x73, 0xf8,
+          0x8b, 0x59, 0x5a, 0x68, 0x79, 0x9f, 0xa1, 0x52, 0xe6, 0xf8, 0xf7, 0x64, 0x7a, 0xac, 0x79, 0x57}},
+        {{0x77, 0x07, 0x6d, 0x0a, 0x73, 0x18, 0xa5, 0x7d, 0x3c, 0x16, 0xc1, 0x72, 0x51, 0xb2, 0x66, 0x45,
+          0xdf, 0x4c, 0x2f, 0x87, 0xeb, 0xc0, 0x99, 0x2a, 0xb1, 0x77, 0xfb, 0xa5, 0x1d, 0xb9, 0x2c, 0x2a},
+         {9},
+         {0x85, 0x20, 0xf0, 0x09, 0x89, 0x30, 0xa7, 0x54, 0x74, 0x8b, 0x7d, 0xdc, 0xb4, 0x3e, 0xf7, 0x5a,
+          0x0d, 0xbf, 0x3a, 0x0d, 0x26, 0x38, 0x1a, 0xf4, 0xeb, 0xa4, 0xa9, 0x8e, 0xaa, 0x9b, 0x4e, 0x6a}},
+        {{0x77, 0x07, 0x6d, 0x0a, 0x73, 0x18, 0xa5, 0x7d, 0x3c, 0x16, 0xc1, 0x72, 0x51, 0xb2, 0x66, 0x45,
+          0xdf, 0x4c, 0x2f, 0x87, 0xeb, 0xc0, 0x99, 0x2a, 0xb1, 0x77, 0xfb, 0xa5, 0x1d, 0xb9, 0x2c, 0x2a},
+         {0xde, 0x9e, 0xdb, 0x7d, 0x7b, 0x7d, 0xc1, 0xb4, 0xd3, 0x5b, 0x61, 0xc2, 0xec, 0xe4, 0x35, 0x37,
+          0x3f, 0x83, 0x43, 0xc8, 0x5b, 0x78, 0x67, 0x4d, 0xad, 0xfc, 0x7e, 0x14, 0x6f, 0x88, 0x2b, 0x4f},
+         {0x4a, 0x5d, 0x9d, 0x5b, 0xa4, 0xce, 0x2d, 0xe1, 0x72, 0x8e, 0x3b, 0xf4, 0x80, 0x35, 0x0f, 0x25,
+          0xe0, 0x7e, 0x21, 0xc9, 0x47, 0xd1, 0x9e, 0x33, 0x76, 0xf0, 0x9b, 0x3c, 0x1e, 0x16, 0x17, 0x42}},
+};
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+int main(void) {
+    u8 out[32];
+    limb a[ELEMENT_SIZE] = {0x3ffffff, 0x1ffffff, 12345, 678, 9, 0x1234567, 42, 0x1abcdef, 7, 0x1000000};
+    limb b[ELEMENT_SIZE] = {0x2345678, 0x0fedcba, 1, 2, 3, 4, 5, 6, 7, 8};
+    double start, elapsed;
+    u32 i;
+
+    // Never report timings of a broken build
+    for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+        curve25519_getshared(out, vectors[i].u, vectors[i].scalar);
+        if (memcmp(out, vectors[i].expected, 32) != 0) {
+            printf("RFC 7748 test vector %u failed\n", i);
+            return 1;
+        }
+    }
+    printf("RFC 7748 test vectors passed\n");
+
+    printf("limb: %u bytes, element: %u bytes, point: %u bytes\n",
+           (u32) sizeof(limb), (u32) ELEMENT_SIZE_BYTES, (u32) sizeof(point));
+
+    start = seconds();
+    for (i = 0; i < ITERATIONS_MUL; ++i) {
+        mul_reduced(a, a, b);
+    }
+    elapsed = seconds() - start;
+    printf("mul_reduced: %8.1f ns\n", elapsed / ITERATIONS_MUL * 1e9);
+
+    start = seconds();
+    for (i = 0; i < ITERATIONS_LADDER; ++i) {
+        curve25519_getshared(out, vectors[0].u, out);
+    }
+    elapsed = seconds() - start;
+    printf("getshared:   %8.1f us\n", elapsed / ITERATIONS_LADDER * 1e6);
+
+    // Keep the compiler from dropping the loops
+    return a[0] == 0 && out[0] == 0;
+}
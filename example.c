@@ -1,5 +1,32 @@
 #include "src/curve25519.h"
+#include "src/elligator.h"
+#include "src/field.h"
+#include "src/keypair.h"
+#include "src/serialize.h"
 #include <stdio.h>
+#include <string.h>
+#include <sys/wait.h> /* waitpid */
+#include <unistd.h> /* fork */
+
+
+/**
+ * Elligator 2 known answers: RFC 7748 public keys of Alice (not representable) and Bob,
+ * a point on the twist (not representable, although -(u + A) / 2u is a square),
+ * and the public key encoded by the representative 00 01 02 ... 1f
+ */
+static const u8 alice_pub[32] =
+        {0x85, 0x20, 0xf0, 0x09, 0x89, 0x30, 0xa7, 0x54, 0x74, 0x8b, 0x7d, 0xdc, 0xb4, 0x3e, 0xf7, 0x5a,
+         0x0d, 0xbf, 0x3a, 0x0d, 0x26, 0x38, 0x1a, 0xf4, 0xeb, 0xa4, 0xa9, 0x8e, 0xaa, 0x9b, 0x4e, 0x6a};
+static const u8 bob_pub[32] =
+        {0xde, 0x9e, 0xdb, 0x7d, 0x7b, 0x7d, 0xc1, 0xb4, 0xd3, 0x5b, 0x61, 0xc2, 0xec, 0xe4, 0x35, 0x37,
+         0x3f, 0x83, 0x43, 0xc8, 0x5b, 0x78, 0x67, 0x4d, 0xad, 0xfc, 0x7e, 0x14, 0x6f, 0x88, 0x2b, 0x4f};
+static const u8 bob_representative[32] =
+        {0x88, 0x41, 0xe5, 0xd3, 0x43, 0xb9, 0xf0, 0x60, 0x7f, 0x5f, 0xdc, 0x11, 0xb2, 0x77, 0xe0, 0xac,
+         0xce, 0x01, 0x19, 0xa2, 0x2e, 0x4c, 0x33, 0x95, 0x0b, 0xa4, 0xaf, 0x7a, 0xa4, 0x98, 0x12, 0x1e};
+static const u8 twist_pub[32] = {2};
+static const u8 counting_pub[32] =
+        {0x5f, 0x35, 0x20, 0x00, 0x1c, 0x6c, 0x99, 0x36, 0xa3, 0x12, 0x06, 0xaf, 0xe7, 0xc7, 0xac, 0x22,
+         0x4e, 0x88, 0x61, 0x61, 0x9b, 0xf9, 0x88, 0x72, 0x44, 0x49, 0x15, 0x89, 0x9d, 0x95, 0xf4, 0x6e};
 
 
 void print_bytes(u8 *bytes) {
@@ -10,6 +37,238 @@ void print_bytes(u8 *bytes) {
 }
 
 
+/**
+ * Check that batch generated public keys (which share one inversion per chunk)
+ * match curve25519_getpub, for batch sizes around the chunk size.
+ * @return 0 if all keys match, 1 otherwise
+ */
+static int check_keypair_batch(void) {
+    static const u32 sizes[] = {1, KEYPAIR_BATCH_CHUNK - 1, KEYPAIR_BATCH_CHUNK, KEYPAIR_BATCH_CHUNK + 1, 100};
+    u8 privs[100 * KEY_SIZE_BYTES], pubs[100 * KEY_SIZE_BYTES], pub[32];
+    u32 i, j;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        if (curve25519_keypair_batch(privs, pubs, sizes[i]) != 0) {
+            puts("Could not get randomness");
+            return 1;
+        }
+        for (j = 0; j < sizes[i]; ++j) {
+            curve25519_getpub(pub, privs + j * KEY_SIZE_BYTES);
+            if (memcmp(pub, pubs + j * KEY_SIZE_BYTES, 32) != 0) {
+                printf("Batch key pair %u of %u failed\n", j, sizes[i]);
+                return 1;
+            }
+        }
+    }
+    puts("Batch key pairs passed");
+    return 0;
+}
+
+/**
+ * Fork, and check that the child starts with empty pools.
+ * @return 0 if the child's pools were empty, 1 otherwise
+ */
+static int pools_empty_after_fork(void) {
+    int status;
+    pid_t pid;
+
+    pid = fork();
+    if (pid == 0) {
+        _exit(keypair_pool_available() == 0 && elligator2_pool_available() == 0 ? 0 : 1);
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        puts("Key pair pools not wiped after fork");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Check the per-thread pool: every popped key pair is valid, no private key is handed
+ * out twice, the pool counts down, popping from an empty pool still yields a valid
+ * key pair, and a forked child starts with an empty pool.
+ * @return 0 if all checks pass, 1 otherwise
+ */
+static int check_keypair_pool(void) {
+    u8 privs[KEYPAIR_POOL_SIZE + 1][KEY_SIZE_BYTES], pubs[KEYPAIR_POOL_SIZE + 1][KEY_SIZE_BYTES], pub[32];
+    u32 i, j;
+
+    keypair_pool_clear();
+    if (keypair_pool_refill() != 0) {
+        puts("Could not refill key pair pool");
+        return 1;
+    }
+
+    for (i = 0; i < KEYPAIR_POOL_SIZE + 1; ++i) {
+        if (keypair_pool_available() != (i < KEYPAIR_POOL_SIZE ? KEYPAIR_POOL_SIZE - i : 0)) {
+            printf("Key pair pool count wrong before pop %u\n", i);
+            return 1;
+        }
+        if (keypair_pool_pop(privs[i], pubs[i]) != 0) {
+            puts("Could not get randomness");
+            return 1;
+        }
+        curve25519_getpub(pub, privs[i]);
+        if (memcmp(pub, pubs[i], 32) != 0) {
+            printf("Pooled key pair %u failed\n", i);
+            return 1;
+        }
+        for (j = 0; j < i; ++j) {
+            if (memcmp(privs[i], privs[j], KEY_SIZE_BYTES) == 0) {
+                printf("Pooled private key %u handed out twice\n", i);
+                return 1;
+            }
+        }
+    }
+
+    if (keypair_pool_refill() != 0) {
+        puts("Could not refill key pair pool");
+        return 1;
+    }
+    if (pools_empty_after_fork() != 0) {
+        return 1;
+    }
+
+    puts("Key pair pool passed");
+    return 0;
+}
+
+/**
+ * Check sqrt_ratio and legendre on small known values.
+ * @return 0 if all values match, 1 otherwise
+ */
+static int check_field(void) {
+    limb two[ELEMENT_SIZE] = {2}, four[ELEMENT_SIZE] = {4};
+    limb r[ELEMENT_SIZE], t[ELEMENT_SIZE];
+    u8 bytes[32], expected[32];
+    int failed = 0;
+
+    failed |= legendre(field_zero) != 0;
+    failed |= legendre(field_one) != 1;
+    failed |= legendre(field_minus_one) != 1;
+    failed |= legendre(two) != -1;
+    failed |= legendre(four) != 1;
+
+    // sqrt(4/1)^2 = 4, sqrt(1/4)^2 * 4 = 1, 2 is no square
+    failed |= sqrt_ratio(r, four, field_one) != 1;
+    square_reduced(t, r);
+    serialize(bytes, t);
+    serialize(expected, four);
+    failed |= memcmp(bytes, expected, 32) != 0;
+
+    failed |= sqrt_ratio(r, field_one, four) != 1;
+    square_reduced(t, r);
+    mul_reduced(r, t, four);
+    serialize(bytes, r);
+    serialize(expected, field_one);
+    failed |= memcmp(bytes, expected, 32) != 0;
+
+    failed |= sqrt_ratio(r, two, field_one) != 0;
+
+    puts(failed ? "Field square root checks failed" : "Field square root checks passed");
+    return failed;
+}
+
+/**
+ * Check Elligator 2 against known answers, decode_batch against decode,
+ * and key pairs from elligator2_keypair in a round trip and a key exchange.
+ * @return 0 if all checks pass, 1 otherwise
+ */
+static int check_elligator(void) {
+    u8 representatives[20 * REPRESENTATIVE_SIZE_BYTES], pubs[20 * KEY_SIZE_BYTES];
+    u8 representative[32], priv[32], pub[32], peer_priv[32], peer_pub[32], shared1[32], shared2[32];
+    u32 i;
+    int failed = 0;
+
+    failed |= elligator2_encode(representative, alice_pub, 0) != 0;
+    failed |= elligator2_encode(representative, twist_pub, 0) != 0;
+    failed |= elligator2_encode(representative, bob_pub, 0) != 1;
+    failed |= memcmp(representative, bob_representative, 32) != 0;
+    elligator2_decode(pub, bob_representative);
+    failed |= memcmp(pub, bob_pub, 32) != 0;
+
+    for (i = 0; i < 32; ++i) {
+        representative[i] = (u8) i;
+    }
+    elligator2_decode(pub, representative);
+    failed |= memcmp(pub, counting_pub, 32) != 0;
+
+    for (i = 0; i < sizeof(representatives); ++i) {
+        representatives[i] = (u8) (i * 167 + 13);
+    }
+    elligator2_decode_batch(pubs, representatives, 20);
+    for (i = 0; i < 20; ++i) {
+        elligator2_decode(pub, representatives + i * REPRESENTATIVE_SIZE_BYTES);
+        failed |= memcmp(pub, pubs + i * KEY_SIZE_BYTES, 32) != 0;
+    }
+
+    if (curve25519_keypair_batch(peer_priv, peer_pub, 1) != 0) {
+        puts("Could not get randomness");
+        return 1;
+    }
+    for (i = 0; i < 8; ++i) {
+        if (elligator2_keypair(representative, priv, (u8) (i << 6)) != 0) {
+            puts("Could not get randomness");
+            return 1;
+        }
+        failed |= (representative[31] & 0xC0) != (u8) (i << 6);
+        elligator2_decode(pub, representative);
+        failed |= elligator2_encode(representative, pub, 0) != 1;
+        curve25519_getshared(shared1, pub, peer_priv);
+        curve25519_getshared(shared2, peer_pub, priv);
+        failed |= memcmp(shared1, shared2, 32) != 0;
+    }
+
+    puts(failed ? "Elligator 2 checks failed" : "Elligator 2 checks passed");
+    return failed;
+}
+
+/**
+ * Check the per-thread Elligator 2 pool through elligator2_keypair: the pool counts down,
+ * every key pair works in a key exchange, no private key is handed out twice, an empty
+ * pool falls back to generating a key pair, and a forked child starts with an empty pool.
+ * @return 0 if all checks pass, 1 otherwise
+ */
+static int check_elligator_pool(void) {
+    u8 privs[KEYPAIR_POOL_SIZE + 1][KEY_SIZE_BYTES];
+    u8 representative[32], pub[32], peer_priv[32], peer_pub[32], shared1[32], shared2[32];
+    u32 i, j;
+    int failed = 0;
+
+    keypair_pool_clear();
+    if (elligator2_pool_refill() != 0 || curve25519_keypair_batch(peer_priv, peer_pub, 1) != 0) {
+        puts("Could not refill Elligator 2 pool");
+        return 1;
+    }
+
+    for (i = 0; i < KEYPAIR_POOL_SIZE + 1; ++i) {
+        failed |= elligator2_pool_available() != (i < KEYPAIR_POOL_SIZE ? KEYPAIR_POOL_SIZE - i : 0);
+        if (elligator2_keypair(representative, privs[i], 0x80) != 0) {
+            puts("Could not get randomness");
+            return 1;
+        }
+        failed |= (representative[31] & 0xC0) != 0x80;
+        elligator2_decode(pub, representative);
+        curve25519_getshared(shared1, pub, peer_priv);
+        curve25519_getshared(shared2, peer_pub, privs[i]);
+        failed |= memcmp(shared1, shared2, 32) != 0;
+        for (j = 0; j < i; ++j) {
+            failed |= memcmp(privs[i], privs[j], KEY_SIZE_BYTES) == 0;
+        }
+    }
+
+    if (elligator2_pool_refill() != 0) {
+        puts("Could not refill Elligator 2 pool");
+        return 1;
+    }
+    failed |= pools_empty_after_fork();
+
+    puts(failed ? "Elligator 2 pool failed" : "Elligator 2 pool passed");
+    return failed;
+}
+
+
+
 int main(void) {
     u8 priv[32] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0xAB,0};
     u8 priv2[32] = {0xCC,0xCC,0xCC,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0xAB,0};
@@ -33,4 +292,15 @@ int main(void) {
     curve25519_getshared(shared2, pub2, priv);
     puts("Shared key 2:");
     print_bytes(shared2);
+
+    // Ephemeral keys are taken from the per-thread pool instead of being generated on demand
+    if (keypair_pool_refill() != 0 || keypair_pool_pop(priv, pub) != 0) {
+        puts("Could not get randomness");
+        return 1;
+    }
+    puts("Ephemeral pubkey:");
+    print_bytes(pub);
+
+    return check_keypair_batch() || check_keypair_pool() || check_field() || check_elligator() ||
+           check_elligator_pool();
 }
\ No newline at end of file
@@ -3,13 +3,57 @@
 #include "montgomery.h"
 #include "serialize.h"
 
+#include <errno.h>
 #include <string.h>
+#include <sys/random.h> /* getrandom */
 
 
 /**
  * Specified generator point with x=9,z=1
  */
-static const s64 generator[ELEMENT_SIZE] = {9};
+static const limb generator[ELEMENT_SIZE] = {9};
+
+/**
+ * x coordinate of the generator plus a point of order 8,
+ * which makes it a point of order 8 times the group order.
+ */
+static const u8 dirty_base[KEY_SIZE_BYTES] = {
+        0xbb, 0x72, 0x31, 0x21, 0x70, 0xe8, 0x15, 0x6f, 0x7a, 0x83, 0x63, 0x13, 0xf8, 0x5b, 0xee, 0x9b,
+        0x1f, 0xdc, 0xe9, 0x26, 0xba, 0x98, 0x04, 0xa2, 0x9e, 0x8d, 0x13, 0x7e, 0xc6, 0x7f, 0x25, 0x33
+};
+
+/**
+ * Order of the prime order subgroup, 2^252 + 27742317777372353535851937790883648493
+ */
+static const u8 group_order[KEY_SIZE_BYTES] = {
+        0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+/**
+ * Fill a buffer with bytes from the kernel CSPRNG.
+ * getrandom() may return fewer bytes than requested for large buffers or when
+ * interrupted by a signal, so keep asking until the buffer is full.
+ * @param buf Output buffer
+ * @param len Number of bytes to fill
+ * @return 0 on success, -1 if the kernel refused to deliver randomness
+ */
+static int fill_random(u8 *buf, size_t len) {
+    ssize_t got;
+
+    while (len > 0) {
+        got = getrandom(buf, len, 0);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += got;
+        len -= (size_t) got;
+    }
+    return 0;
+}
 
 /**
  * Curve25519 primitive as described in the djb paper.
@@ -18,19 +62,13 @@ static const s64 generator[ELEMENT_SIZE] = {9};
  * @param scalar Scalar stating how often the basepoint has to be added to itself
  * @param basepoint Basepoint to add.
  */
-static void curve25519(u8 *out, const u8 *scalar, const s64 *basepoint) {
-    s64 z_inv[ELEMENT_SIZE];
+static void curve25519(u8 *out, const u8 *scalar, const limb *basepoint) {
+    limb z_inv[ELEMENT_SIZE];
     uint8_t e[KEY_SIZE_BYTES];
     point P;
 
     memcpy(e, scalar, KEY_SIZE_BYTES);
-
-    // set lowest 3 bits to zero to get multiple of 8, to avoid small subgroups
-    e[0] &= 0xF8;
-
-    // discard highest bit
-    e[31] &= 0x7F;
-    e[31] |= 0x40;
+    curve25519_clamp(e);
 
     montgomery_ladder(&P, e, basepoint);
     invert(z_inv, P.z);
@@ -39,6 +77,20 @@ static void curve25519(u8 *out, const u8 *scalar, const s64 *basepoint) {
 }
 
 
+/**
+ * Clamp a 32 byte scalar as specified in [1] and [3].
+ * @param scalar 32 byte little-endian scalar, modified in place
+ */
+void curve25519_clamp(u8 *scalar) {
+    // set lowest 3 bits to zero to get multiple of 8, to avoid small subgroups
+    scalar[0] &= 0xF8;
+
+    // discard highest bit
+    scalar[31] &= 0x7F;
+    scalar[31] |= 0x40;
+}
+
+
 /**
  * Calculate the public key for a given private key.
  * This uses the specified generator (x=9, z=1) as basepoint.
@@ -56,7 +108,117 @@ void curve25519_getpub(u8 *pubkey, const u8 *secret) {
  * @param secret 32 byte little-endian scalar to multiply on generator
  */
 void curve25519_getshared(u8 *shared, const u8 *pubkey, const u8 *privkey) {
-    s64 pubkey_fe[ELEMENT_SIZE] = {0,};
+    limb pubkey_fe[ELEMENT_SIZE] = {0,};
     deserialize(pubkey_fe, pubkey);
     curve25519(shared, privkey, pubkey_fe);
 }
+
+
+/**
+ * Add t times the group order to a clamped scalar.
+ * The result still fits into 256 bits, as the scalar is < 2^255 and t * order < 2^255.
+ * @param scalar 32 byte little-endian scalar, modified in place
+ * @param t Multiple of the group order to add, at most 7
+ */
+static void add_order_multiple(u8 *scalar, u32 t) {
+    u32 i, carry = 0;
+
+    for (i = 0; i < KEY_SIZE_BYTES; ++i) {
+        carry += scalar[i] + t * group_order[i];
+        scalar[i] = (u8) carry;
+        carry >>= 8;
+    }
+}
+
+/**
+ * Common part of curve25519_keypair_batch and curve25519_keypair_dirty_batch.
+ * All scalars are read from the kernel into the caller's buffer at once and are clamped
+ * in place. Keys are then produced in chunks of KEYPAIR_BATCH_CHUNK, whose projective
+ * ladder results share one field inversion (see invert_batch) instead of paying
+ * for one inversion per key.
+ * @param privs Output, n clamped 32 byte private keys back to back
+ * @param pubs Output, n 32 byte public keys back to back
+ * @param n Number of key pairs to generate
+ * @param dirty 1 to add a random low order point to the public keys, 0 for regular keys
+ * @return 0 on success, -1 if no randomness could be obtained
+ */
+static int keypair_batch(u8 *privs, u8 *pubs, size_t n, s32 dirty) {
+    point P;
+    limb base[ELEMENT_SIZE] = {0,};
+    limb z[KEYPAIR_BATCH_CHUNK][ELEMENT_SIZE];
+    limb x[KEYPAIR_BATCH_CHUNK][ELEMENT_SIZE];
+    limb z_inv[KEYPAIR_BATCH_CHUNK][ELEMENT_SIZE];
+    limb affine[ELEMENT_SIZE];
+    u8 e[KEY_SIZE_BYTES];
+    u32 i, chunk, low;
+
+    if (fill_random(privs, n * KEY_SIZE_BYTES) != 0) {
+        return -1;
+    }
+
+    if (dirty) {
+        deserialize(base, dirty_base);
+    } else {
+        COPY_ELEM(base, generator);
+    }
+
+    while (n > 0) {
+        chunk = n < KEYPAIR_BATCH_CHUNK ? (u32) n : KEYPAIR_BATCH_CHUNK;
+
+        for (i = 0; i < chunk; ++i) {
+            // The 3 random bits that clamping discards pick the low order component
+            low = privs[i * KEY_SIZE_BYTES] & 7;
+            curve25519_clamp(privs + i * KEY_SIZE_BYTES);
+            memcpy(e, privs + i * KEY_SIZE_BYTES, KEY_SIZE_BYTES);
+            if (dirty) {
+                add_order_multiple(e, (5 * low) & 7);
+            }
+            montgomery_ladder(&P, e, base);
+            COPY_ELEM(x[i], P.x);
+            COPY_ELEM(z[i], P.z);
+        }
+
+        invert_batch(z_inv, (const limb (*)[ELEMENT_SIZE]) z, chunk);
+
+        for (i = 0; i < chunk; ++i) {
+            mul_reduced(affine, x[i], z_inv[i]);
+            serialize(pubs + i * KEY_SIZE_BYTES, affine);
+        }
+
+        privs += (size_t) chunk * KEY_SIZE_BYTES;
+        pubs += (size_t) chunk * KEY_SIZE_BYTES;
+        n -= chunk;
+    }
+
+    memset(e, 0, KEY_SIZE_BYTES);
+    return 0;
+}
+
+/**
+ * Generate n fresh key pairs, see keypair_batch.
+ * @param privs Output, n clamped 32 byte private keys back to back
+ * @param pubs Output, n 32 byte public keys back to back
+ * @param n Number of key pairs to generate
+ * @return 0 on success, -1 if no randomness could be obtained
+ */
+int curve25519_keypair_batch(u8 *privs, u8 *pubs, size_t n) {
+    return keypair_batch(privs, pubs, n, 0);
+}
+
+/**
+ * Generate n fresh key pairs whose public keys are not restricted to the prime order subgroup.
+ * Public keys of clamped private keys always are, which an observer of Elligator
+ * representatives can test for. Here, each public key additionally contains a random
+ * multiple of a point of order 8, chosen by the 3 random low bits that clamping discards.
+ * The scalar e = k + t * order is used on a base point of order 8 * order, with t picked
+ * such that e = k (mod order) and e = low bits (mod 8), since order = 5 (mod 8) and 5 * 5 = 1 (mod 8).
+ * Any peer's clamped private key is a multiple of 8 and cancels the low order part,
+ * so the returned clamped private keys work as usual.
+ * @param privs Output, n clamped 32 byte private keys back to back
+ * @param pubs Output, n 32 byte public keys back to back
+ * @param n Number of key pairs to generate
+ * @return 0 on success, -1 if no randomness could be obtained
+ */
+int curve25519_keypair_dirty_batch(u8 *privs, u8 *pubs, size_t n) {
+    return keypair_batch(privs, pubs, n, 1);
+}
@@ -3,10 +3,21 @@
 
 #include "types.h"
 
+#include <stddef.h> /* size_t */
+
 #define KEY_SIZE_BYTES 32
 
+/* Number of keys that share one field inversion */
+#define KEYPAIR_BATCH_CHUNK 16
+
+void curve25519_clamp(u8 *scalar);
+
 void curve25519_getpub(u8 *pubkey, const u8 *secret);
 
 void curve25519_getshared(u8 *shared, const u8 *pubkey, const u8 *privkey);
 
+int curve25519_keypair_batch(u8 *privs, u8 *pubs, size_t n);
+
+int curve25519_keypair_dirty_batch(u8 *privs, u8 *pubs, size_t n);
+
 #endif //EDU25519_CURVE25519_H
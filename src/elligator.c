@@ -0,0 +1,194 @@
+#include "elligator.h"
+#include "curve25519.h"
+#include "field.h"
+#include "keypair.h"
+#include "serialize.h"
+
+#include <string.h> /* memcpy */
+
+
+/**
+ * Curve constant A of y^2 = x^3 + A*x^2 + x
+ */
+static const limb curve_a[ELEMENT_SIZE] = {486662};
+
+/**
+ * Map a public key to its Elligator 2 representative, see [5] section 5.3.
+ * With the non-square 2, the representative of u is r = sqrt(-(u + A) / (2u)),
+ * which exists for roughly half of all public keys. Of the two roots, the one
+ * in [0, (p-1)/2] is used, so r has at most 254 bits and the top two bits of
+ * the output are filled with the top two bits of tweak.
+ *
+ * Public keys of clamped private keys lie in the prime order subgroup, which an
+ * observer can test for after decoding. Use elligator2_keypair (or keys from
+ * curve25519_keypair_dirty_batch) for representatives that are indistinguishable from random.
+ * @param representative Output, 32 bytes indistinguishable from random if the key is representable
+ * @param pubkey 32 byte public key
+ * @param tweak Random byte, of which the top two bits are used as padding
+ * @return 1 if pubkey is a point on the curve and representable, 0 otherwise (the output is garbage then)
+ */
+s32 elligator2_encode(u8 *representative, const u8 *pubkey, u8 tweak) {
+    limb u[ELEMENT_SIZE] = {0,};
+    limb num[ELEMENT_SIZE], den[ELEMENT_SIZE], r[ELEMENT_SIZE], t[ELEMENT_SIZE];
+    s32 ok;
+
+    deserialize(u, pubkey);
+
+    // num = -(u + A), which must not be zero
+    COPY_ELEM(num, u);
+    add(num, curve_a);
+    reduce(num);
+    ok = 1 - is_zero(num);
+
+    /* u must be on the curve and not on its twist, i.e. u^3 + A*u^2 + u = u * (u * (u + A) + 1)
+     * must be a square. Otherwise, the representative would decode to -u - A instead. */
+    mul_reduced(t, num, u);
+    add(t, field_one);
+    mul_reduced(r, t, u);
+    ok &= legendre(r) >= 0;
+
+    sub(num, field_zero);
+
+    // den = 2u, which must not be zero
+    COPY_ELEM(den, u);
+    add(den, u);
+    ok &= 1 - is_zero(den);
+
+    ok &= sqrt_ratio(r, num, den);
+
+    /* r is in [0, (p-1)/2] exactly if 2r < p, i.e. if 2r does not wrap around
+     * the (odd) modulus and therefore stays even. Otherwise, use -r. */
+    COPY_ELEM(t, r);
+    add(t, r);
+    reduce(t);
+    COPY_ELEM(num, r);
+    sub(num, field_zero);
+    cmov(r, num, is_negative(t));
+
+    serialize(representative, r);
+    representative[31] |= tweak & 0xC0;
+
+    return ok;
+}
+
+/**
+ * First half of the Elligator 2 map: the denominator d = 1 + 2r^2 of w = -A / d.
+ * Since 2 is no square, d can never be zero.
+ * @param d Output, reduced denominator
+ * @param representative 32 byte representative, the top two bits are ignored
+ */
+static void decode_denominator(limb *d, const u8 *representative) {
+    limb r[ELEMENT_SIZE] = {0,};
+    u8 bytes[REPRESENTATIVE_SIZE_BYTES];
+
+    memcpy(bytes, representative, REPRESENTATIVE_SIZE_BYTES);
+    bytes[31] &= 0x3F;
+    deserialize(r, bytes);
+
+    square_reduced(d, r);
+    add(d, d);
+    add(d, field_one);
+    reduce(d);
+}
+
+/**
+ * Second half of the Elligator 2 map, see [5] section 5.2.
+ * w = -A / d is a valid x coordinate if w^3 + A*w^2 + w is a square,
+ * otherwise -w - A is.
+ * @param pubkey Output, 32 byte public key
+ * @param d_inv Inverse of the denominator computed by decode_denominator
+ */
+static void decode_finish(u8 *pubkey, const limb *d_inv) {
+    limb w[ELEMENT_SIZE], u[ELEMENT_SIZE], f[ELEMENT_SIZE], t[ELEMENT_SIZE];
+
+    // w = -A / d
+    mul_reduced(w, curve_a, d_inv);
+    sub(w, field_zero);
+
+    // f = w * (w * (w + A) + 1) = w^3 + A*w^2 + w
+    COPY_ELEM(t, w);
+    add(t, curve_a);
+    mul_reduced(f, t, w);
+    add(f, field_one);
+    mul_reduced(t, f, w);
+
+    // u = -w - A, unless f is a square (or zero)
+    COPY_ELEM(u, w);
+    add(u, curve_a);
+    sub(u, field_zero);
+    cmov(u, w, legendre(t) >= 0);
+
+    serialize(pubkey, u);
+}
+
+/**
+ * Map an Elligator 2 representative back to the public key it encodes.
+ * Every 254 bit string decodes to some valid public key.
+ * @param pubkey Output, 32 byte public key
+ * @param representative 32 byte representative
+ */
+void elligator2_decode(u8 *pubkey, const u8 *representative) {
+    limb d[ELEMENT_SIZE], d_inv[ELEMENT_SIZE];
+
+    decode_denominator(d, representative);
+    invert(d_inv, d);
+    decode_finish(pubkey, d_inv);
+}
+
+/**
+ * Decode n representatives, sharing one field inversion per ELLIGATOR_BATCH_CHUNK keys.
+ * @param pubkeys Output, n 32 byte public keys back to back
+ * @param representatives n 32 byte representatives back to back
+ * @param n Number of keys
+ */
+void elligator2_decode_batch(u8 *pubkeys, const u8 *representatives, size_t n) {
+    limb d[ELLIGATOR_BATCH_CHUNK][ELEMENT_SIZE];
+    limb d_inv[ELLIGATOR_BATCH_CHUNK][ELEMENT_SIZE];
+    u32 i, chunk;
+
+    while (n > 0) {
+        chunk = n < ELLIGATOR_BATCH_CHUNK ? (u32) n : ELLIGATOR_BATCH_CHUNK;
+
+        for (i = 0; i < chunk; ++i) {
+            decode_denominator(d[i], representatives + i * REPRESENTATIVE_SIZE_BYTES);
+        }
+
+        invert_batch(d_inv, (const limb (*)[ELEMENT_SIZE]) d, chunk);
+
+        for (i = 0; i < chunk; ++i) {
+            decode_finish(pubkeys + i * KEY_SIZE_BYTES, d_inv[i]);
+        }
+
+        pubkeys += (size_t) chunk * KEY_SIZE_BYTES;
+        representatives += (size_t) chunk * REPRESENTATIVE_SIZE_BYTES;
+        n -= chunk;
+    }
+}
+
+/**
+ * Generate a key pair whose public key is representable, and return its representative.
+ * Public keys come from curve25519_keypair_dirty_batch, so they are spread over the whole
+ * curve and not only the prime order subgroup.
+ * If the calling thread's Elligator 2 pool (see elligator2_pool_refill) has a key pair left,
+ * it is popped in O(1). Otherwise, only about half of all public keys can be encoded,
+ * so generating one on the spot takes two ladders on average.
+ * The public key is not returned, elligator2_decode recovers it from the representative.
+ * @param representative Output, 32 byte representative of the public key
+ * @param privkey Output, 32 byte clamped private key
+ * @param tweak Random byte, of which the top two bits are used as padding
+ * @return 0 on success, -1 if no randomness could be obtained
+ */
+int elligator2_keypair(u8 *representative, u8 *privkey, u8 tweak) {
+    u8 pubkey[KEY_SIZE_BYTES];
+
+    if (elligator2_pool_pop(representative, privkey, tweak) == 0) {
+        return 0;
+    }
+
+    do {
+        if (curve25519_keypair_dirty_batch(privkey, pubkey, 1) != 0) {
+            return -1;
+        }
+    } while (!elligator2_encode(representative, pubkey, tweak));
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef EDU25519_ELLIGATOR_H
+#define EDU25519_ELLIGATOR_H
+
+#include "types.h"
+
+#include <stddef.h> /* size_t */
+
+#define REPRESENTATIVE_SIZE_BYTES 32
+
+/* Number of representatives that share one field inversion when decoding */
+#define ELLIGATOR_BATCH_CHUNK 16
+
+s32 elligator2_encode(u8 *representative, const u8 *pubkey, u8 tweak);
+
+void elligator2_decode(u8 *pubkey, const u8 *representative);
+
+void elligator2_decode_batch(u8 *pubkeys, const u8 *representatives, size_t n);
+
+int elligator2_keypair(u8 *representative, u8 *privkey, u8 tweak);
+
+#endif //EDU25519_ELLIGATOR_H
@@ -1,7 +1,27 @@
 #include "field.h"
+#include "serialize.h" /* equality is checked on the canonical encoding */
 
 #include <string.h>  /* memset */
 
+/* Widening 32x32->64 bit product. The operands are limbs, which are < 2^28 even when unreduced,
+ * so with 32 bit limbs this compiles to a single multiply instruction instead of a 64x64 one. */
+#define MUL_WIDE(x, y) ((s64) (x) * (y))
+
+/**
+ * Commonly used constant elements.
+ */
+const limb field_zero[ELEMENT_SIZE] = {0};
+const limb field_one[ELEMENT_SIZE] = {1};
+const limb field_minus_one[ELEMENT_SIZE] = {-1};
+
+/**
+ * sqrt(-1) = 2^((p-1)/4) (mod p), in the radix 2^25.5 representation.
+ */
+static const limb sqrt_m1[ELEMENT_SIZE] = {
+        -32595792, -7943725, 9377950, 3500415, 12389472,
+        -272473, -25146209, -2005654, 326686, 11406482
+};
+
 /**
  * Does straight forward integer multiplication (operand scanning form), see [1] p.32.
  * The returned polynomial is not reduced.
@@ -9,10 +29,10 @@
  * @param a Operand 1
  * @param b Operand 2
  */
-void mul(s64 *result, const s64 *a, const s64 *b) {
+void mul(s64 *result, const limb *a, const limb *b) {
     u32 i, j;
 
-    memset(result, 0, ELEMENT_SIZE_BYTES);
+    memset(result, 0, PRODUCT_SIZE_BYTES);
 
     for (i = 0; i < 10; ++i) {
         for (j = 0; j < 10; ++j) {
@@ -21,38 +41,57 @@ void mul(s64 *result, const s64 *a, const s64 *b) {
                 // Here we store the product of two odd indices,
                 // that is two 25bit numbers in an even index,
                 // therefore a 26bit number
-                result[i + j] += 2 * a[i] * b[j];
+                result[i + j] += MUL_WIDE(2 * a[i], b[j]);
             } else {
-                result[i + j] += a[i] * b[j];
+                result[i + j] += MUL_WIDE(a[i], b[j]);
             }
         }
     }
 }
 
+/**
+ * Store the 10 coefficients of a reduced product as limbs.
+ * @param result Reduced element
+ * @param poly Product after reduce_degree and reduce_coefficients
+ */
+static void narrow(limb *result, const s64 *poly) {
+    u32 i;
+    for (i = 0; i < 10; ++i) {
+        result[i] = (limb) poly[i];
+    }
+}
+
 /**
  * Multiply two polynomials and reduce them degree and coefficient wise.
  * result = a * b (mod p)
- * @param result Reduced polynomial product of a and b
+ * @param result Reduced polynomial product of a and b, may overlap with a or b
  * @param a Operand 1
  * @param b Operand 2
  */
-void mul_reduced(s64 *result, const s64 *a, const s64 *b) {
-    mul(result, a, b);
-    reduce_degree(result);
-    reduce_coefficients(result);
+void mul_reduced(limb *result, const limb *a, const limb *b) {
+    s64 product[PRODUCT_SIZE];
+
+    mul(product, a, b);
+    reduce_degree(product);
+    reduce_coefficients(product);
+    narrow(result, product);
 }
 
 /**
  * Multiply the evaluation of the polynomial at 1
- * with constant 121665. See [1] for explanation of constant.
- * @param result a(1) * 121665
+ * with constant 121665 and reduce it. See [1] for explanation of constant.
+ * @param result a(1) * 121665 (mod p)
  * @param a Operand 1
  */
-void mul_constant(s64 *result, const s64 *a) {
+void mul_constant(limb *result, const limb *a) {
+    s64 product[PRODUCT_SIZE] = {0,};
     u32 i;
+
     for (i = 0; i < 10; ++i) {
-        result[i] = a[i] * 121665;
+        product[i] = MUL_WIDE(a[i], 121665);
     }
+    reduce_coefficients(product);
+    narrow(result, product);
 }
 
 /**
@@ -61,7 +100,7 @@ void mul_constant(s64 *result, const s64 *a) {
  * @param result The squared element
  * @param a Operand 1
  */
-void square(s64 *result, const s64 *a) {
+void square(s64 *result, const limb *a) {
     mul(result, a, a);
 }
 
@@ -70,10 +109,13 @@ void square(s64 *result, const s64 *a) {
  * @param result
  * @param a
  */
-void square_reduced(s64 *result, const s64 *a) {
-    square(result, a);
-    reduce_degree(result);
-    reduce_coefficients(result);
+void square_reduced(limb *result, const limb *a) {
+    s64 product[PRODUCT_SIZE];
+
+    square(product, a);
+    reduce_degree(product);
+    reduce_coefficients(product);
+    narrow(result, product);
 }
 
 /**
@@ -82,7 +124,7 @@ void square_reduced(s64 *result, const s64 *a) {
  * @param result Result and Operand 1
  * @param a Operand 2
  */
-void add(s64 *result, const s64 *a) {
+void add(limb *result, const limb *a) {
     u32 i;
     for (i = 0; i < 10; ++i) {
         result[i] += a[i];
@@ -96,7 +138,7 @@ void add(s64 *result, const s64 *a) {
  * @param result Result and Operand 1
  * @param a Operand 2
  */
-void sub(s64 *result, const s64 *a) {
+void sub(limb *result, const limb *a) {
     u32 i;
     for (i = 0; i < 10; ++i) {
         result[i] = a[i] - result[i];
@@ -179,40 +221,243 @@ void reduce_coefficients(s64 *poly) {
 }
 
 /**
- * Invert the polynomial by taking it to the power of p-2.
+ * Reduce the coefficients of an element that grew through add or sub,
+ * by widening it for reduce_coefficients.
+ * @param poly Element with 10 coefficients
+ */
+void reduce(limb *poly) {
+    s64 wide[PRODUCT_SIZE] = {0,};
+    u32 i;
+
+    for (i = 0; i < 10; ++i) {
+        wide[i] = poly[i];
+    }
+    reduce_coefficients(wide);
+    narrow(poly, wide);
+}
+
+/**
+ * Square the polynomial n times in a row and reduce it.
+ * Result = a^(2^n)
+ * @param result The repeatedly squared element
+ * @param a Operand 1
+ * @param n Number of squarings, at least 1
+ */
+static void square_times(limb *result, const limb *a, u32 n) {
+    u32 i;
+
+    square_reduced(result, a);
+    for (i = 1; i < n; ++i) {
+        square_reduced(result, result);
+    }
+}
+
+/**
+ * Common part of the exponentiations below, using the addition chain from the
+ * ref10 code of Ed25519 (254 squarings and 11 multiplications).
+ * Builds a^(2^k-1) for growing k until k = 250 is reached.
+ * @param result a^(2^250-1)
+ * @param a11 a^11, which is a by-product of the chain
+ * @param a Operand 1
+ */
+static void pow_2_250_1(limb *result, limb *a11, const limb *a) {
+    limb t0[ELEMENT_SIZE], t1[ELEMENT_SIZE], t2[ELEMENT_SIZE];
+
+    square_reduced(t0, a);             // 2
+    square_times(t1, t0, 2);           // 8
+    mul_reduced(t2, t1, a);            // 9
+    mul_reduced(a11, t0, t2);          // 11
+    square_reduced(t0, a11);           // 22
+    mul_reduced(t1, t0, t2);           // 2^5 - 1
+
+    square_times(t0, t1, 5);
+    mul_reduced(t2, t0, t1);           // 2^10 - 1
+    square_times(t0, t2, 10);
+    mul_reduced(t1, t0, t2);           // 2^20 - 1
+    square_times(t0, t1, 20);
+    mul_reduced(result, t0, t1);       // 2^40 - 1
+    square_times(t0, result, 10);
+    mul_reduced(t1, t0, t2);           // 2^50 - 1
+    square_times(t0, t1, 50);
+    mul_reduced(t2, t0, t1);           // 2^100 - 1
+    square_times(t0, t2, 100);
+    mul_reduced(result, t0, t2);       // 2^200 - 1
+    square_times(t0, result, 50);
+    mul_reduced(result, t0, t1);       // 2^250 - 1
+}
+
+/**
+ * Invert the polynomial by taking it to the power of p-2 = 2^255-21.
  * Result = a^-1 (mod p)
  * @param result Inverse element of a.
  * @param a Operand 1
  */
-void invert(s64 *result, const s64 *a) {
-    s64 tmp_result[20] = {0,};
-    tmp_result[0] = 1;
+void invert(limb *result, const limb *a) {
+    limb t0[ELEMENT_SIZE], t1[ELEMENT_SIZE], a11[ELEMENT_SIZE];
+
+    pow_2_250_1(t0, a11, a);
+    // (2^250 - 1) * 2^5 + 11 = 2^255 - 21
+    square_times(t1, t0, 5);
+    mul_reduced(result, t1, a11);
+}
+
+/**
+ * Raise the polynomial to the power of (p-5)/8 = 2^252-3, which is
+ * the core of square root computations for p = 5 (mod 8), see [3] and [4].
+ * Result = a^((p-5)/8) (mod p)
+ * @param result a^(2^252-3)
+ * @param a Operand 1
+ */
+void pow22523(limb *result, const limb *a) {
+    limb t0[ELEMENT_SIZE], t1[ELEMENT_SIZE], a11[ELEMENT_SIZE];
+
+    pow_2_250_1(t0, a11, a);
+    // (2^250 - 1) * 2^2 + 1 = 2^252 - 3
+    square_times(t1, t0, 2);
+    mul_reduced(result, t1, a);
+}
+
+/**
+ * Compare two polynomials in constant time, by comparing their canonical encodings.
+ * @param a Operand 1
+ * @param b Operand 2
+ * @return 1 if a = b (mod p), 0 otherwise
+ */
+static s32 equal(const limb *a, const limb *b) {
+    u8 a_bytes[32], b_bytes[32];
+    u32 i, diff = 0;
+
+    serialize(a_bytes, a);
+    serialize(b_bytes, b);
+    for (i = 0; i < 32; ++i) {
+        diff |= a_bytes[i] ^ b_bytes[i];
+    }
+    return (s32) (((diff - 1) >> 8) & 1);
+}
+
+/**
+ * Check whether the polynomial evaluates to zero mod p.
+ * @param a Operand 1
+ * @return 1 if a = 0 (mod p), 0 otherwise
+ */
+s32 is_zero(const limb *a) {
+    return equal(a, field_zero);
+}
+
+/**
+ * Check the sign of the polynomial, which is defined as the lowest
+ * bit of its canonical encoding (see [4]).
+ * @param a Operand 1
+ * @return 1 if a (mod p) is odd, 0 otherwise
+ */
+s32 is_negative(const limb *a) {
+    u8 bytes[32];
+
+    serialize(bytes, a);
+    return bytes[0] & 1;
+}
+
+/**
+ * Constant time conditional move.
+ * If flag is 1, result is overwritten with a. If flag is zero, it isn't.
+ * @param result Result and Operand 1
+ * @param a Operand 2
+ * @param flag Decision Maker (has to be 0 or 1)
+ */
+void cmov(limb *result, const limb *a, s32 flag) {
     u32 i;
+    limb mask = -(limb) flag;
 
-    // Use the hardcoded binary representation of 2^255-21
-    // 250 x 1
-    for (i = 0; i < 250; ++i) {
-        square_reduced(result, tmp_result);
-        mul_reduced(tmp_result, result, a);
+    for (i = 0; i < 10; ++i) {
+        result[i] ^= mask & (result[i] ^ a[i]);
     }
+}
+
+/**
+ * Compute the square root of a fraction without an inversion, see [4].
+ * With x = u * v^3 * (u * v^7)^((p-5)/8), v * x^2 is either u, -u or neither,
+ * and in the second case the root is fixed up by multiplying with sqrt(-1).
+ * Result = sqrt(u / v) (mod p)
+ * @param result A square root of u/v if it exists, garbage otherwise
+ * @param u Numerator
+ * @param v Denominator
+ * @return 1 if u/v is a square (or u is zero), 0 otherwise
+ */
+s32 sqrt_ratio(limb *result, const limb *u, const limb *v) {
+    limb v3[ELEMENT_SIZE], v7[ELEMENT_SIZE], t0[ELEMENT_SIZE], t1[ELEMENT_SIZE];
+    limb check[ELEMENT_SIZE], neg_u[ELEMENT_SIZE];
+    s32 correct, flipped;
+
+    square_reduced(t0, v);
+    mul_reduced(v3, t0, v);            // v^3
+    square_reduced(t0, v3);
+    mul_reduced(v7, t0, v);            // v^7
+
+    mul_reduced(t0, u, v7);
+    pow22523(t1, t0);                  // (u * v^7)^((p-5)/8)
+    mul_reduced(t0, t1, v3);
+    mul_reduced(result, t0, u);        // u * v^3 * (u * v^7)^((p-5)/8)
+
+    square_reduced(t0, result);
+    mul_reduced(check, t0, v);         // v * x^2
+
+    COPY_ELEM(neg_u, u);
+    sub(neg_u, field_zero);
+
+    correct = equal(check, u);
+    flipped = equal(check, neg_u);
+
+    mul_reduced(t0, result, sqrt_m1);
+    cmov(result, t0, flipped);
+
+    return correct | flipped;
+}
 
-    // 0
-    square_reduced(result, tmp_result);
+/**
+ * Compute the legendre symbol of the polynomial via Euler's criterion,
+ * Result = a^((p-1)/2) (mod p), where (p-1)/2 = 4 * (2^252-3) + 2.
+ * @param a Operand 1
+ * @return 1 if a is a non-zero square, -1 if it is no square, 0 if a = 0 (mod p)
+ */
+s32 legendre(const limb *a) {
+    limb t0[ELEMENT_SIZE], t1[ELEMENT_SIZE], a2[ELEMENT_SIZE];
+
+    pow22523(t0, a);
+    square_times(t1, t0, 2);           // a^(2^254-12)
+    square_reduced(a2, a);
+    mul_reduced(t0, t1, a2);           // a^(2^254-10)
+
+    return equal(t0, field_one) - equal(t0, field_minus_one);
+}
 
-    // 1
-    square_reduced(tmp_result, result);
-    mul_reduced(result, tmp_result, a);
+/**
+ * Invert n elements at the cost of a single inversion (Montgomery's trick, see [2] p.44).
+ * First the running products a[0]*...*a[i] are stored in results, then the inverse
+ * of the full product is walked back down, peeling off one factor per step.
+ * results[i] = a[i]^-1 (mod p)
+ * @param results Array of n inverse elements, must not overlap with a
+ * @param a Array of n reduced elements, none of which may be zero
+ * @param n Number of elements
+ */
+void invert_batch(limb (*results)[ELEMENT_SIZE], const limb (*a)[ELEMENT_SIZE], u32 n) {
+    limb inv[ELEMENT_SIZE];
+    u32 i;
 
-    // 0
-    square_reduced(tmp_result, result);
+    if (n == 0) {
+        return;
+    }
 
-    // 1
-    square_reduced(result, tmp_result);
-    mul_reduced(tmp_result, result, a);
+    COPY_ELEM(results[0], a[0]);
+    for (i = 1; i < n; ++i) {
+        mul_reduced(results[i], results[i - 1], a[i]);
+    }
 
-    // 1
-    square_reduced(result, tmp_result);
-    mul_reduced(tmp_result, result, a);
+    invert(inv, results[n - 1]);
 
-    COPY_ELEM(result, tmp_result);
+    for (i = n - 1; i > 0; --i) {
+        // results[i] = (a[0]*...*a[i])^-1 * (a[0]*...*a[i-1]) = a[i]^-1
+        mul_reduced(results[i], inv, results[i - 1]);
+        mul_reduced(inv, inv, a[i]);
+    }
+    COPY_ELEM(results[0], inv);
 }
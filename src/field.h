@@ -3,30 +3,53 @@
 
 #include "types.h"
 
-#define ELEMENT_SIZE 20
-#define ELEMENT_SIZE_BYTES (ELEMENT_SIZE * sizeof(s64))
+/* A reduced element has 10 coefficients, an unreduced product up to 19 (+1 for carrying) */
+#define ELEMENT_SIZE 10
+#define ELEMENT_SIZE_BYTES (ELEMENT_SIZE * sizeof(limb))
+#define PRODUCT_SIZE 20
+#define PRODUCT_SIZE_BYTES (PRODUCT_SIZE * sizeof(s64))
 
 #define IS_ODD(x) ((x)&1)
 #define COPY_ELEM(x, y) memcpy((x), (y), ELEMENT_SIZE_BYTES)
 
-void mul(s64 *result, const s64 *a, const s64 *b);
+extern const limb field_zero[ELEMENT_SIZE];
+extern const limb field_one[ELEMENT_SIZE];
+extern const limb field_minus_one[ELEMENT_SIZE];
+
+void mul(s64 *result, const limb *a, const limb *b);
 
 void reduce_degree(s64 *poly);
 
 void reduce_coefficients(s64 *poly);
 
-void mul_reduced(s64 *result, const s64 *a, const s64 *b);
+void reduce(limb *poly);
+
+void mul_reduced(limb *result, const limb *a, const limb *b);
+
+void add(limb *result, const limb *a);
+
+void sub(limb *result, const limb *a);
+
+void square(s64 *result, const limb *a);
+
+void square_reduced(limb *result, const limb *a);
+
+void invert(limb *result, const limb *a);
+
+void invert_batch(limb (*results)[ELEMENT_SIZE], const limb (*a)[ELEMENT_SIZE], u32 n);
+
+void mul_constant(limb *result, const limb *a);
 
-void add(s64 *result, const s64 *a);
+void pow22523(limb *result, const limb *a);
 
-void sub(s64 *result, const s64 *a);
+s32 sqrt_ratio(limb *result, const limb *u, const limb *v);
 
-void square(s64 *result, const s64 *a);
+s32 legendre(const limb *a);
 
-void square_reduced(s64 *result, const s64 *a);
+s32 is_zero(const limb *a);
 
-void invert(s64 *result, const s64 *a);
+s32 is_negative(const limb *a);
 
-void mul_constant(s64 *result, const s64 *a);
+void cmov(limb *result, const limb *a, s32 flag);
 
 #endif //EDU25519_FIELD_H
\ No newline at end of file
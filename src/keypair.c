@@ -0,0 +1,214 @@
+#include "keypair.h"
+#include "curve25519.h"
+#include "elligator.h"
+
+#include <pthread.h> /* pthread_atfork, thread exit hook */
+#include <string.h> /* memcpy, memset */
+
+
+/**
+ * Per-thread stack of ready-to-use key pairs.
+ * Being thread local, no locking is needed to pop or refill.
+ */
+typedef struct {
+    u8 privs[KEYPAIR_POOL_SIZE][KEY_SIZE_BYTES];
+    u8 pubs[KEYPAIR_POOL_SIZE][KEY_SIZE_BYTES];
+    size_t count;
+} keypair_pool;
+
+/**
+ * All pools of a thread: regular key pairs, and Elligator 2 key pairs
+ * which store the representative (without padding) instead of the public key.
+ */
+typedef struct {
+    keypair_pool plain;
+    keypair_pool elligator;
+} thread_pools;
+
+static _Thread_local thread_pools pools;
+
+static pthread_once_t hooks_once = PTHREAD_ONCE_INIT;
+static pthread_key_t exit_key;
+static int hooks_failed;
+
+/**
+ * Wipe all key pairs of a thread's pools, including the private keys.
+ * @param p Pools to wipe
+ */
+static void wipe_pools(void *p) {
+    memset(p, 0, sizeof(thread_pools));
+}
+
+/**
+ * Runs in the child after fork(). Without it, parent and child
+ * would hand out the very same pre-generated private keys.
+ */
+static void clear_after_fork(void) {
+    keypair_pool_clear();
+}
+
+/**
+ * Register the fork handler, and the thread exit hook which
+ * wipes the leftover private keys of a terminating thread.
+ * If either can't be registered, pools must never be filled.
+ */
+static void install_hooks(void) {
+    if (pthread_key_create(&exit_key, wipe_pools) != 0) {
+        hooks_failed = 1;
+        return;
+    }
+    if (pthread_atfork(NULL, NULL, clear_after_fork) != 0) {
+        hooks_failed = 1;
+    }
+}
+
+/**
+ * Make sure the calling thread's pools are wiped after fork() and on thread exit.
+ * Has to succeed before anything is put into a pool.
+ * @return 0 on success, -1 if the hooks could not be installed
+ */
+static int protect_pools(void) {
+    if (pthread_once(&hooks_once, install_hooks) != 0 || hooks_failed) {
+        return -1;
+    }
+    if (pthread_setspecific(exit_key, &pools) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Top up the calling thread's pool to KEYPAIR_POOL_SIZE key pairs.
+ * This is the expensive part and is meant to be called off the hot path,
+ * e.g. from an event loop's idle callback or after a connection was set up.
+ * @return 0 on success, -1 if no randomness could be obtained or the pool
+ *         could not be protected against fork() and thread exit
+ */
+int keypair_pool_refill(void) {
+    keypair_pool *pool = &pools.plain;
+    size_t missing = KEYPAIR_POOL_SIZE - pool->count;
+
+    if (missing == 0) {
+        return 0;
+    }
+
+    if (protect_pools() != 0) {
+        return -1;
+    }
+    if (curve25519_keypair_batch(pool->privs[pool->count], pool->pubs[pool->count], missing) != 0) {
+        return -1;
+    }
+    pool->count = KEYPAIR_POOL_SIZE;
+    return 0;
+}
+
+/**
+ * Take one key pair out of the calling thread's pool in O(1).
+ * The slot is wiped after copying, so every key pair is handed out only once.
+ * If the pool ran dry, a single key pair is generated synchronously instead
+ * (one ladder), the pool itself is only refilled by keypair_pool_refill.
+ * @param privkey Output, 32 byte clamped private key
+ * @param pubkey Output, 32 byte public key belonging to privkey
+ * @return 0 on success, -1 if the pool was empty and no randomness could be obtained
+ */
+int keypair_pool_pop(u8 *privkey, u8 *pubkey) {
+    keypair_pool *pool = &pools.plain;
+
+    if (pool->count == 0) {
+        return curve25519_keypair_batch(privkey, pubkey, 1);
+    }
+
+    --pool->count;
+    memcpy(privkey, pool->privs[pool->count], KEY_SIZE_BYTES);
+    memcpy(pubkey, pool->pubs[pool->count], KEY_SIZE_BYTES);
+    memset(pool->privs[pool->count], 0, KEY_SIZE_BYTES);
+    return 0;
+}
+
+/**
+ * Number of key pairs the calling thread can pop without triggering a refill.
+ * @return Key pairs left in the pool
+ */
+size_t keypair_pool_available(void) {
+    return pools.plain.count;
+}
+
+/**
+ * Wipe all key pairs of the calling thread's pools, including the Elligator 2 pool.
+ * Pools are cleared automatically in the child after fork() and when a thread exits,
+ * this is for processes that clone themselves in other ways, e.g. by restoring a snapshot.
+ */
+void keypair_pool_clear(void) {
+    wipe_pools(&pools);
+}
+
+/**
+ * Top up the calling thread's Elligator 2 pool to KEYPAIR_POOL_SIZE key pairs.
+ * Candidates are generated ELLIGATOR_BATCH_CHUNK at a time with curve25519_keypair_dirty_batch,
+ * sharing one inversion, and the representable half of them is kept. Candidates left over
+ * once the pool is full are wiped. Like keypair_pool_refill, call it off the hot path.
+ * @return 0 on success, -1 if no randomness could be obtained or the pool
+ *         could not be protected against fork() and thread exit
+ */
+int elligator2_pool_refill(void) {
+    keypair_pool *pool = &pools.elligator;
+    u8 privs[ELLIGATOR_BATCH_CHUNK * KEY_SIZE_BYTES];
+    u8 pubs[ELLIGATOR_BATCH_CHUNK * KEY_SIZE_BYTES];
+    u8 representative[REPRESENTATIVE_SIZE_BYTES];
+    u32 i;
+    int ret = 0;
+
+    if (pool->count < KEYPAIR_POOL_SIZE && protect_pools() != 0) {
+        return -1;
+    }
+
+    while (pool->count < KEYPAIR_POOL_SIZE) {
+        if (curve25519_keypair_dirty_batch(privs, pubs, ELLIGATOR_BATCH_CHUNK) != 0) {
+            ret = -1;
+            break;
+        }
+        for (i = 0; i < ELLIGATOR_BATCH_CHUNK && pool->count < KEYPAIR_POOL_SIZE; ++i) {
+            if (elligator2_encode(representative, pubs + i * KEY_SIZE_BYTES, 0)) {
+                memcpy(pool->privs[pool->count], privs + i * KEY_SIZE_BYTES, KEY_SIZE_BYTES);
+                memcpy(pool->pubs[pool->count], representative, REPRESENTATIVE_SIZE_BYTES);
+                ++pool->count;
+            }
+        }
+    }
+
+    memset(privs, 0, sizeof(privs));
+    return ret;
+}
+
+/**
+ * Take one Elligator 2 key pair out of the calling thread's pool in O(1).
+ * The slot is wiped after copying, so every key pair is handed out only once.
+ * Unlike keypair_pool_pop, nothing is generated if the pool is empty,
+ * elligator2_keypair falls back to generating a key pair itself then.
+ * @param representative Output, 32 byte representative of the public key
+ * @param privkey Output, 32 byte clamped private key
+ * @param tweak Random byte, of which the top two bits are used as padding
+ * @return 0 on success, -1 if the pool was empty
+ */
+int elligator2_pool_pop(u8 *representative, u8 *privkey, u8 tweak) {
+    keypair_pool *pool = &pools.elligator;
+
+    if (pool->count == 0) {
+        return -1;
+    }
+
+    --pool->count;
+    memcpy(privkey, pool->privs[pool->count], KEY_SIZE_BYTES);
+    memcpy(representative, pool->pubs[pool->count], REPRESENTATIVE_SIZE_BYTES);
+    representative[31] |= tweak & 0xC0;
+    memset(pool->privs[pool->count], 0, KEY_SIZE_BYTES);
+    return 0;
+}
+
+/**
+ * Number of Elligator 2 key pairs the calling thread can pop from its pool.
+ * @return Key pairs left in the pool
+ */
+size_t elligator2_pool_available(void) {
+    return pools.elligator.count;
+}
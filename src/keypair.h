@@ -0,0 +1,27 @@
+#ifndef EDU25519_KEYPAIR_H
+#define EDU25519_KEYPAIR_H
+
+#include "types.h"
+
+#include <stddef.h> /* size_t */
+
+/* Number of pre-generated key pairs each thread keeps around */
+#define KEYPAIR_POOL_SIZE 64
+
+int keypair_pool_refill(void);
+
+/* Popping from an empty pool generates one key pair on the spot, which costs a full ladder */
+int keypair_pool_pop(u8 *privkey, u8 *pubkey);
+
+size_t keypair_pool_available(void);
+
+void keypair_pool_clear(void);
+
+int elligator2_pool_refill(void);
+
+/* Unlike keypair_pool_pop, popping from an empty Elligator 2 pool fails with -1 */
+int elligator2_pool_pop(u8 *representative, u8 *privkey, u8 tweak);
+
+size_t elligator2_pool_available(void);
+
+#endif //EDU25519_KEYPAIR_H
@@ -13,8 +13,9 @@
  * @param c Operand 2
  * @param base X value of base point
  */
-static void double_add(point *res_double, point *res_add, const point *a, const point *c, const s64 *base) {
-    s64 A[20], B[20], C[20], D[20], E[20], F[20], G[20], H[20];
+static void double_add(point *res_double, point *res_add, const point *a, const point *c, const limb *base) {
+    limb A[ELEMENT_SIZE], B[ELEMENT_SIZE], C[ELEMENT_SIZE], D[ELEMENT_SIZE];
+    limb E[ELEMENT_SIZE], F[ELEMENT_SIZE], G[ELEMENT_SIZE], H[ELEMENT_SIZE];
 
     COPY_ELEM(&A, a->x);
     COPY_ELEM(&B, a->z);
@@ -54,7 +55,6 @@ static void double_add(point *res_double, point *res_add, const point *a, const
 
     // C = 121665 * (G - H)
     mul_constant(C, H);
-    reduce_coefficients(C);
     add(G, C);
     // D = (G-h) * (G + 121665 * (G - H))
     mul_reduced(D, H, G);
@@ -69,19 +69,19 @@ static void double_add(point *res_double, point *res_add, const point *a, const
  * @param b Operand 2
  * @param swap Decision Maker (has to be 0 or 1)
  */
-static void swap_points(point *a, point *b, s64 swap) {
+static void swap_points(point *a, point *b, limb swap) {
     u32 i;
-    s32 mask = (s32) -swap;
-    s32 x;
+    limb mask = -swap;
+    limb x;
 
     for (i = 0; i < 10; ++i) {
-        x = mask & (((s32) a->x[i]) ^ ((s32) b->x[i]));
-        a->x[i] = ((s32) a->x[i]) ^ x;
-        b->x[i] = ((s32) b->x[i]) ^ x;
+        x = mask & (a->x[i] ^ b->x[i]);
+        a->x[i] ^= x;
+        b->x[i] ^= x;
 
-        x = mask & (((s32) a->z[i]) ^ ((s32) b->z[i]));
-        a->z[i] = ((s32) a->z[i]) ^ x;
-        b->z[i] = ((s32) b->z[i]) ^ x;
+        x = mask & (a->z[i] ^ b->z[i]);
+        a->z[i] ^= x;
+        b->z[i] ^= x;
     }
 }
 
@@ -92,7 +92,7 @@ static void swap_points(point *a, point *b, s64 swap) {
  * @param scalar Scalar to multiply on basepoint
  * @param basepoint x value of the base point to use for scalar multiplication
  */
-void montgomery_ladder(point *result, const u8 *scalar, const s64 *basepoint) {
+void montgomery_ladder(point *result, const u8 *scalar, const limb *basepoint) {
     point A = {{1},
                {0}};
     point B = {{0},
@@ -2,12 +2,13 @@
 #define EDU25519_MONTGOMERY_H
 
 #include "types.h"
+#include "field.h" /* ELEMENT_SIZE */
 
 typedef struct {
-    s64 x[20];
-    s64 z[20];
+    limb x[ELEMENT_SIZE];
+    limb z[ELEMENT_SIZE];
 } point;
 
-void montgomery_ladder(point *result, const u8 *scalar, const s64 *basepoint);
+void montgomery_ladder(point *result, const u8 *scalar, const limb *basepoint);
 
 #endif //EDU25519_MONTGOMERY_H
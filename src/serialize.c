@@ -19,7 +19,7 @@
  * @param mask How many bits to keep (26 for even index, 25 for odd...)
  */
 static inline void assign_coeff(
-        s64 *poly, const u8 *bytes, const u32 index, const u32 offset, const u32 cutoff, const u32 mask) {
+        limb *poly, const u8 *bytes, const u32 index, const u32 offset, const u32 cutoff, const u32 mask) {
     poly[index] = ((u32) bytes[offset + 0]) | ((u32) bytes[offset + 1]) << 8 | ((u32) bytes[offset + 2]) << 16 |
                   ((u32) bytes[offset + 3]) << 24;
     poly[index] >>= cutoff;
@@ -28,10 +28,10 @@ static inline void assign_coeff(
 
 /***
  * Turn a 32 byte string into polynomial form.
- * @param poly Output Poly, array of 10 64 bit limbs
+ * @param poly Output Poly, array of 10 limbs
  * @param bytes Little endian 32B byte array
  */
-void deserialize(s64 *poly, const u8 *bytes) {
+void deserialize(limb *poly, const u8 *bytes) {
     // This is hard coded, just so we don't need to compute anything at runtime
     assign_coeff(poly, bytes, 0, 0, 0, MASK_L26);
     assign_coeff(poly, bytes, 1, 3, 2, MASK_L25);
@@ -70,7 +70,7 @@ static s32 s32_gte(s32 a, s32 b) {
  * @param bytes Little endian 32B byte array
  * @param poly Reduced output Poly
  */
-void serialize(u8 *bytes, const s64 *poly) {
+void serialize(u8 *bytes, const limb *poly) {
     /*
      * This code is largely taken from Adam Langley's donna implementation.
      * It makes sure that we evaluate the polynomial at 1 and takes care of
@@ -11,4 +11,15 @@ typedef uint8_t u8;
 typedef uint32_t u32;
 typedef uint64_t u64;
 
+/* Storage type of one coefficient of a field element.
+ * Reduced coefficients fit into 26 bits, so 32 bit limbs are enough to store them,
+ * only products have to be accumulated in 64 bits (see mul in field.c).
+ * The 64 bit default avoids sign extensions on 64 bit targets, 32 bit limbs halve
+ * the memory footprint on 32 bit targets. */
+#ifdef EDU25519_LIMB32
+typedef s32 limb;
+#else
+typedef s64 limb;
+#endif
+
 #endif //EDU25519_TYPES_H